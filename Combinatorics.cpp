@@ -14,10 +14,6 @@
 using namespace SphericalFunctions;
 using std::vector;
 
-const FactorialSingleton* FactorialSingleton::FactorialInstance = 0;
-const BinomialCoefficientSingleton* BinomialCoefficientSingleton::BinomialCoefficientInstance = 0;
-const LadderOperatorFactorSingleton* LadderOperatorFactorSingleton::LadderOperatorFactorInstance = 0;
-
 // #ifndef USE_GSL
 /// Evaluate Wigner's 3-j symbol
 double SphericalFunctions::Wigner3j(int j_1, int j_2, int j_3, int m_1, int m_2, int m_3) {
@@ -19,7 +19,6 @@ namespace SphericalFunctions {
 
   class FactorialSingleton {
   private:
-    static const FactorialSingleton* FactorialInstance;
     std::vector<double> FactorialTable;
     FactorialSingleton() : FactorialTable(171) {
       FactorialTable[0] = 1.0;
@@ -27,19 +26,16 @@ namespace SphericalFunctions {
         FactorialTable[i] = i*FactorialTable[i-1];
       }
     }
-    FactorialSingleton(const FactorialSingleton& that) {
-      FactorialInstance = that.FactorialInstance;
-    }
-    FactorialSingleton& operator=(const FactorialSingleton& that) {
-      if(this!=&that) FactorialInstance = that.FactorialInstance;
-      return *this;
-    }
+    FactorialSingleton(const FactorialSingleton&);
+    FactorialSingleton& operator=(const FactorialSingleton&);
     ~FactorialSingleton() { }
   public:
     static const FactorialSingleton& Instance() {
+      // The local static is initialized exactly once, even if several
+      // threads call this at the same time.  Nothing else is written
+      // here, so any number of threads may call this concurrently.
       static const FactorialSingleton Instance;
-      FactorialInstance = &Instance;
-      return *FactorialInstance;
+      return Instance;
     }
     inline double operator[](const unsigned int i) const {
       #ifdef DEBUG
@@ -66,7 +62,6 @@ namespace SphericalFunctions {
   /// Object for pre-computing and retrieving binomials
   class BinomialCoefficientSingleton {
   private:
-    static const BinomialCoefficientSingleton* BinomialCoefficientInstance;
     std::vector<double> BinomialCoefficientTable;
     BinomialCoefficientSingleton()
       : BinomialCoefficientTable(2*ellMax*ellMax + 3*ellMax + 1)
@@ -79,19 +74,13 @@ namespace SphericalFunctions {
         }
       }
     }
-    BinomialCoefficientSingleton(const BinomialCoefficientSingleton& that) {
-      BinomialCoefficientInstance = that.BinomialCoefficientInstance;
-    }
-    BinomialCoefficientSingleton& operator=(const BinomialCoefficientSingleton& that) {
-      if(this!=&that) BinomialCoefficientInstance = that.BinomialCoefficientInstance;
-      return *this;
-    }
+    BinomialCoefficientSingleton(const BinomialCoefficientSingleton&);
+    BinomialCoefficientSingleton& operator=(const BinomialCoefficientSingleton&);
     ~BinomialCoefficientSingleton() { }
   public:
     static const BinomialCoefficientSingleton& Instance() {
       static const BinomialCoefficientSingleton Instance;
-      BinomialCoefficientInstance = &Instance;
-      return *BinomialCoefficientInstance;
+      return Instance;
     }
     inline double operator()(const unsigned int n, const unsigned int k) const {
       #ifdef DEBUG
@@ -108,7 +97,6 @@ namespace SphericalFunctions {
 
   class LadderOperatorFactorSingleton {
   private:
-    static const LadderOperatorFactorSingleton* LadderOperatorFactorInstance;
     std::vector<double> FactorTable;
     LadderOperatorFactorSingleton()
       : FactorTable(ellMax*ellMax + 2*ellMax + 1)
@@ -120,19 +108,13 @@ namespace SphericalFunctions {
         }
       }
     }
-    LadderOperatorFactorSingleton(const LadderOperatorFactorSingleton& that) {
-      LadderOperatorFactorInstance = that.LadderOperatorFactorInstance;
-    }
-    LadderOperatorFactorSingleton& operator=(const LadderOperatorFactorSingleton& that) {
-      if(this!=&that) LadderOperatorFactorInstance = that.LadderOperatorFactorInstance;
-      return *this;
-    }
+    LadderOperatorFactorSingleton(const LadderOperatorFactorSingleton&);
+    LadderOperatorFactorSingleton& operator=(const LadderOperatorFactorSingleton&);
     ~LadderOperatorFactorSingleton() { }
   public:
     static const LadderOperatorFactorSingleton& Instance() {
       static const LadderOperatorFactorSingleton Instance;
-      LadderOperatorFactorInstance = &Instance;
-      return *LadderOperatorFactorInstance;
+      return Instance;
     }
     inline double operator()(const int ell, const int m) const {
       #ifdef DEBUG
@@ -7,9 +7,13 @@
 // Note: These error codes are used in SphericalFunctions.i.
 //       If you change them here, change them there.
 
+// Functions that return a status code rather than throwing return
+// this on success, or one of the codes below on failure.
+#define NoError -1
+
 #define NotYetImplemented 0
 // #define FailedSystemCall 1
-// #define BadFileName 2
+#define BadFileName 2
 // #define FailedGSLCall 3
 // #define  4
 // #define  5
@@ -0,0 +1,82 @@
+// Copyright (c) 2014, Michael Boyle
+// See LICENSE file for details
+
+// Compare the timing of `WignerDMatrix::operator()` using the
+// precombined sum-coefficient table against computing those
+// coefficients from the binomial table on each call.  Build with
+//   make benchmark
+// from the top-level directory, then run `./BenchmarkWignerDMatrices`.
+//
+// Both layouts run the same Horner loop; only the source of the
+// coefficients differs.  Since the prefactor's calls to `std::pow`
+// dominate the cost of each element, the two are typically within
+// about 10% of each other, at every ell.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include "WignerDMatrices.hpp"
+
+using namespace SphericalFunctions;
+using Quaternions::Quaternion;
+
+// Sum all D matrix elements up to ellMaxBenchmark for each rotor,
+// returning the time taken in seconds
+double Time(WignerDMatrix& D, const std::vector<Quaternion>& Rotors, const int ellMaxBenchmark, std::complex<double>& Total) {
+  const std::clock_t Start = std::clock();
+  for(unsigned int i=0; i<Rotors.size(); ++i) {
+    D.SetRotation(Rotors[i]);
+    for(int ell=0; ell<=ellMaxBenchmark; ++ell) {
+      for(int mp=-ell; mp<=ell; ++mp) {
+        for(int m=-ell; m<=ell; ++m) {
+          Total += D(ell, mp, m);
+        }
+      }
+    }
+  }
+  return double(std::clock()-Start)/CLOCKS_PER_SEC;
+}
+
+int main() {
+  const unsigned int NRotors = 500;
+  std::srand(1234);
+  std::vector<Quaternion> Rotors(NRotors);
+  for(unsigned int i=0; i<NRotors; ++i) {
+    Rotors[i] = Quaternion(2*M_PI*std::rand()/double(RAND_MAX),
+                           M_PI*std::rand()/double(RAND_MAX),
+                           2*M_PI*std::rand()/double(RAND_MAX));
+  }
+
+  WignerDMatrix D(Rotors[0]);
+  // Make sure the tables are built before timing anything
+  D.UseSumCoefficientTable = true;
+  D(ellMax, 0, 0);
+
+  std::cout << std::setw(6) << "ellMax" << std::setw(16) << "binomial (s)" << std::setw(16) << "contiguous (s)"
+            << std::setw(10) << "speedup" << std::setw(16) << "max |diff|" << std::endl;
+  for(int ellMaxBenchmark=2; ellMaxBenchmark<=ellMax; ellMaxBenchmark*=2) {
+    std::complex<double> TotalBinomial(0.0), TotalContiguous(0.0);
+    D.UseSumCoefficientTable = false;
+    const double TimeBinomial = Time(D, Rotors, ellMaxBenchmark, TotalBinomial);
+    D.UseSumCoefficientTable = true;
+    const double TimeContiguous = Time(D, Rotors, ellMaxBenchmark, TotalContiguous);
+    double MaxDiff = 0.0;
+    for(unsigned int i=0; i<Rotors.size(); i+=100) {
+      D.SetRotation(Rotors[i]);
+      for(int mp=-ellMaxBenchmark; mp<=ellMaxBenchmark; ++mp) {
+        for(int m=-ellMaxBenchmark; m<=ellMaxBenchmark; ++m) {
+          D.UseSumCoefficientTable = false;
+          const std::complex<double> a = D(ellMaxBenchmark, mp, m);
+          D.UseSumCoefficientTable = true;
+          MaxDiff = std::max(MaxDiff, std::abs(a-D(ellMaxBenchmark, mp, m)));
+        }
+      }
+    }
+    std::cout << std::setw(6) << ellMaxBenchmark << std::setw(16) << TimeBinomial << std::setw(16) << TimeContiguous
+              << std::setw(10) << TimeBinomial/TimeContiguous << std::setw(16) << MaxDiff << std::endl;
+  }
+
+  return 0;
+}
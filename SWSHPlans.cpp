@@ -0,0 +1,334 @@
+// Copyright (c) 2014, Michael Boyle
+// See LICENSE file for details
+
+#include "SWSHPlans.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include "Errors.hpp"
+
+#define INFOTOCERR std::cerr << __FILE__ << ":" << __LINE__ << ":" << __func__ << ": "
+
+using namespace SphericalFunctions;
+using Quaternions::Quaternion;
+using std::vector;
+using std::complex;
+
+// Number of points whose SWSH values are held together while every
+// mode vector passes through them
+const unsigned int SWSHPlanBlockSize = 32;
+
+// Identifies files written by SWSHPlan::Write
+const char SWSHPlanFileTag[8] = {'S','W','S','H','P','l','a','n'};
+const int SWSHPlanFileVersion = 1;
+
+
+/// Construct the plan for the given spin, points, and ell range.
+SWSHPlan::SWSHPlan(const int s, const std::vector<Quaternions::Quaternion>& iPoints, const int iEllMin, const int iEllMax,
+                   const StorageType iStorage, const std::vector<double>& iWeights)
+  : spin(s), ellMinPlan(std::max(iEllMin, std::abs(s))), ellMaxPlan(iEllMax), Storage(iStorage),
+    Points(iPoints), Weights(iWeights)
+{
+  ///
+  /// \param s Spin weight of the functions
+  /// \param iPoints Rotors giving the points (see the `SWSH` documentation)
+  /// \param iEllMin Smallest ell in the plan (raised to abs(s) if necessary)
+  /// \param iEllMax Largest ell in the plan
+  /// \param iStorage One of `SWSHPlan.Dense` (default), `SWSHPlan.Factored`, or `SWSHPlan.OnTheFly`
+  /// \param iWeights Optional quadrature weights for each point, used by `Project`
+  ///
+  /// If no weights are given, each point is assumed to represent an
+  /// equal area \f$4\pi/N\f$ of the sphere, as for HEALPix-like grids.
+  if(iEllMin<0 || iEllMin>iEllMax || iEllMax>ellMax) {
+    INFOTOCERR << "(ellMin, ellMax) = (" << iEllMin << ", " << iEllMax << "); need 0 <= ellMin <= ellMax <= " << ellMax << "."
+               << "\nTo increase this bound, edit 'ellMax' in Combinatorics.hpp and recompile." << std::endl;
+    throw(IndexOutOfBounds);
+  }
+  if(std::abs(s)>iEllMax) {
+    INFOTOCERR << "|s| = " << std::abs(s) << " > ellMax = " << iEllMax << "; no SWSHs of this spin are in the plan's range." << std::endl;
+    throw(ValueError);
+  }
+  if(Weights.size()==0) {
+    Weights = vector<double>(Points.size(), 4*M_PI/Points.size());
+  }
+  if(Weights.size()!=Points.size()) {
+    INFOTOCERR << "Weights.size()=" << Weights.size() << " but Points.size()=" << Points.size() << "." << std::endl;
+    throw(ValueError);
+  }
+  Build();
+}
+
+/// Read a plan previously written by `Write`.
+SWSHPlan::SWSHPlan(const std::string& FileName)
+  : spin(0), ellMinPlan(0), ellMaxPlan(0), Storage(Dense)
+{
+  std::ifstream File(FileName.c_str(), std::ios::in | std::ios::binary);
+  if(!File) {
+    INFOTOCERR << "Could not open '" << FileName << "' for reading." << std::endl;
+    throw(BadFileName);
+  }
+  char Tag[8];
+  int Version, StorageInt;
+  unsigned int NPoints;
+  File.read(Tag, 8);
+  File.read(reinterpret_cast<char*>(&Version), sizeof(int));
+  if(!File || std::memcmp(Tag, SWSHPlanFileTag, 8)!=0 || Version!=SWSHPlanFileVersion) {
+    INFOTOCERR << "'" << FileName << "' is not an SWSHPlan file of version " << SWSHPlanFileVersion << "." << std::endl;
+    throw(ValueError);
+  }
+  File.read(reinterpret_cast<char*>(&spin), sizeof(int));
+  File.read(reinterpret_cast<char*>(&ellMinPlan), sizeof(int));
+  File.read(reinterpret_cast<char*>(&ellMaxPlan), sizeof(int));
+  File.read(reinterpret_cast<char*>(&StorageInt), sizeof(int));
+  File.read(reinterpret_cast<char*>(&NPoints), sizeof(unsigned int));
+  if(!File || ellMinPlan<std::abs(spin) || ellMinPlan>ellMaxPlan || ellMaxPlan>ellMax || StorageInt<Dense || StorageInt>OnTheFly) {
+    INFOTOCERR << "'" << FileName << "' has a corrupt header." << std::endl;
+    throw(ValueError);
+  }
+  Storage = StorageType(StorageInt);
+  Points.resize(NPoints);
+  Weights.resize(NPoints);
+  for(unsigned int p=0; p<NPoints; ++p) {
+    double q[4];
+    File.read(reinterpret_cast<char*>(q), 4*sizeof(double));
+    Points[p] = Quaternion(q[0], q[1], q[2], q[3]);
+  }
+  if(NPoints>0) {
+    File.read(reinterpret_cast<char*>(&Weights[0]), NPoints*sizeof(double));
+  }
+  const unsigned int N = NModes();
+  if(Storage==Dense) {
+    SWSHValues.resize(NPoints*N);
+    if(NPoints>0) { File.read(reinterpret_cast<char*>(&SWSHValues[0]), SWSHValues.size()*sizeof(complex<double>)); }
+  } else if(Storage==Factored) {
+    Amplitudes.resize(NPoints*N);
+    Phases.resize(2*NPoints);
+    if(NPoints>0) {
+      File.read(reinterpret_cast<char*>(&Amplitudes[0]), Amplitudes.size()*sizeof(double));
+      File.read(reinterpret_cast<char*>(&Phases[0]), Phases.size()*sizeof(complex<double>));
+    }
+  }
+  if(!File) {
+    INFOTOCERR << "'" << FileName << "' ended unexpectedly." << std::endl;
+    throw(ValueError);
+  }
+}
+
+/// Write the plan to a binary file, which may be read by the corresponding constructor.
+void SWSHPlan::Write(const std::string& FileName) const {
+  ///
+  /// \param FileName
+  ///
+  /// The file is written in the native byte order and floating-point
+  /// format, so it should only be read on the same kind of machine.
+  std::ofstream File(FileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!File) {
+    INFOTOCERR << "Could not open '" << FileName << "' for writing." << std::endl;
+    throw(BadFileName);
+  }
+  const int StorageInt = Storage;
+  const unsigned int NPoints = Points.size();
+  File.write(SWSHPlanFileTag, 8);
+  File.write(reinterpret_cast<const char*>(&SWSHPlanFileVersion), sizeof(int));
+  File.write(reinterpret_cast<const char*>(&spin), sizeof(int));
+  File.write(reinterpret_cast<const char*>(&ellMinPlan), sizeof(int));
+  File.write(reinterpret_cast<const char*>(&ellMaxPlan), sizeof(int));
+  File.write(reinterpret_cast<const char*>(&StorageInt), sizeof(int));
+  File.write(reinterpret_cast<const char*>(&NPoints), sizeof(unsigned int));
+  for(unsigned int p=0; p<NPoints; ++p) {
+    const double q[4] = { Points[p][0], Points[p][1], Points[p][2], Points[p][3] };
+    File.write(reinterpret_cast<const char*>(q), 4*sizeof(double));
+  }
+  if(NPoints>0) {
+    File.write(reinterpret_cast<const char*>(&Weights[0]), NPoints*sizeof(double));
+    if(Storage==Dense) {
+      File.write(reinterpret_cast<const char*>(&SWSHValues[0]), SWSHValues.size()*sizeof(complex<double>));
+    } else if(Storage==Factored) {
+      File.write(reinterpret_cast<const char*>(&Amplitudes[0]), Amplitudes.size()*sizeof(double));
+      File.write(reinterpret_cast<const char*>(&Phases[0]), Phases.size()*sizeof(complex<double>));
+    }
+  }
+  if(!File) {
+    INFOTOCERR << "Failed while writing '" << FileName << "'." << std::endl;
+    throw(BadFileName);
+  }
+}
+
+/// Compute the stored SWSH data for the chosen storage type.
+void SWSHPlan::Build() {
+  const unsigned int N = NModes();
+  const unsigned int NPoints = Points.size();
+  if(Storage==Dense) {
+    SWSHValues.resize(NPoints*N);
+  } else if(Storage==Factored) {
+    Amplitudes.resize(NPoints*N);
+    Phases.resize(2*NPoints);
+  } else {
+    return;
+  }
+  #ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic)
+  #endif
+  for(int p=0; p<int(NPoints); ++p) {
+    const SWSH Y(spin, Points[p]);
+    if(Storage==Dense) {
+      complex<double>* Values = &SWSHValues[p*N];
+      for(int ell=ellMinPlan, i=0; ell<=ellMaxPlan; ++ell) {
+        for(int m=-ell; m<=ell; ++m, ++i) {
+          Values[i] = Y(ell, m);
+        }
+      }
+    } else {
+      // Each SWSH is a real number times Ra^(m-s) Rb^(-s-m), so its
+      // phase is U^m V, where U and V depend only on the point
+      const Quaternion& R = Points[p];
+      const complex<double> Ra(R[0], R[3]), Rb(R[2], R[1]);
+      const complex<double> ra = (std::abs(Ra)>epsilon ? Ra/std::abs(Ra) : complex<double>(1.0));
+      const complex<double> rb = (std::abs(Rb)>epsilon ? Rb/std::abs(Rb) : complex<double>(1.0));
+      const complex<double> U = ra*std::conj(rb);
+      const complex<double> V = std::pow(ra*rb, -spin);
+      Phases[2*p] = U;
+      Phases[2*p+1] = V;
+      double* Amplitude = &Amplitudes[p*N];
+      for(int ell=ellMinPlan, i=0; ell<=ellMaxPlan; ++ell) {
+        for(int m=-ell; m<=ell; ++m, ++i) {
+          Amplitude[i] = std::real(Y(ell, m) * std::conj(std::pow(U, m)*V));
+        }
+      }
+    }
+  }
+}
+
+/// Return the SWSH values for point p, computing them into Buffer if they are not stored.
+const std::complex<double>* SWSHPlan::Row(const unsigned int p, std::complex<double>* Buffer) const {
+  const unsigned int N = NModes();
+  if(Storage==Dense) {
+    return &SWSHValues[p*N];
+  } else if(Storage==Factored) {
+    const complex<double> U = Phases[2*p];
+    const complex<double> V = Phases[2*p+1];
+    complex<double> UPowers[2*ellMax+1];
+    UPowers[ellMaxPlan] = V;
+    for(int m=1; m<=ellMaxPlan; ++m) {
+      UPowers[ellMaxPlan+m] = UPowers[ellMaxPlan+m-1] * U;
+      UPowers[ellMaxPlan-m] = UPowers[ellMaxPlan-m+1] * std::conj(U);
+    }
+    const double* Amplitude = &Amplitudes[p*N];
+    for(int ell=ellMinPlan, i=0; ell<=ellMaxPlan; ++ell) {
+      for(int m=-ell; m<=ell; ++m, ++i) {
+        Buffer[i] = Amplitude[i] * UPowers[ellMaxPlan+m];
+      }
+    }
+  } else {
+    const SWSH Y(spin, Points[p]);
+    for(int ell=ellMinPlan, i=0; ell<=ellMaxPlan; ++ell) {
+      for(int m=-ell; m<=ell; ++m, ++i) {
+        Buffer[i] = Y(ell, m);
+      }
+    }
+  }
+  return Buffer;
+}
+
+/// Evaluate each set of modes at every point of the plan.
+int SWSHPlan::Evaluate(const std::vector<std::vector<std::complex<double> > >& Modes,
+                       std::vector<std::vector<std::complex<double> > >& Data) const {
+  ///
+  /// \param Modes vector<vector<complex<double> > > indexed as [time][mode], each in spinsfast order
+  /// \param Data Output vector<vector<complex<double> > > indexed as [time][point]
+  ///
+  /// Modes outside the ell range of the plan are ignored; missing
+  /// modes are treated as zero, so any input is valid.  Like the
+  /// other batch functions, this never throws, and returns
+  /// `NoError`.
+  const unsigned int N = NModes();
+  const unsigned int NPoints = Points.size();
+  const unsigned int NTimes = Modes.size();
+  const unsigned int iMin = ellMinPlan*ellMinPlan;
+  vector<vector<complex<double> > > Result(NTimes, vector<complex<double> >(NPoints));
+  vector<complex<double> > Buffer(SWSHPlanBlockSize*N);
+  vector<const complex<double>*> Rows(SWSHPlanBlockSize);
+  for(unsigned int p0=0; p0<NPoints; p0+=SWSHPlanBlockSize) {
+    const unsigned int NBlock = std::min(SWSHPlanBlockSize, NPoints-p0);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for(int b=0; b<int(NBlock); ++b) {
+      Rows[b] = Row(p0+b, &Buffer[b*N]);
+    }
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for(int t=0; t<int(NTimes); ++t) {
+      const vector<complex<double> >& M = Modes[t];
+      const unsigned int n = (M.size()>iMin ? std::min(N, (unsigned int)(M.size())-iMin) : 0);
+      for(unsigned int b=0; b<NBlock; ++b) {
+        const complex<double>* Y = Rows[b];
+        complex<double> Sum(0.0);
+        for(unsigned int i=0; i<n; ++i) {
+          Sum += Y[i] * M[iMin+i];
+        }
+        Result[t][p0+b] = Sum;
+      }
+    }
+  }
+  Data.swap(Result);
+  return NoError;
+}
+
+/// Project each set of values at the points of the plan onto modes.
+int SWSHPlan::Project(const std::vector<std::vector<std::complex<double> > >& Data,
+                      std::vector<std::vector<std::complex<double> > >& Modes) const {
+  ///
+  /// \param Data vector<vector<complex<double> > > indexed as [time][point]
+  /// \param Modes Output vector<vector<complex<double> > > indexed as [time][mode]
+  ///
+  /// The modes are in spinsfast order up to the largest ell of the
+  /// plan; modes below the smallest ell of the plan are zero.  The
+  /// integrals are approximated using the weights given to the
+  /// constructor, so the result is only exact if those weights form a
+  /// quadrature rule that is exact for the relevant functions.
+  ///
+  /// The sizes of all elements of `Data` are checked before anything
+  /// is computed.  This function never throws and never writes to
+  /// `std::cerr`.  It returns `NoError` on success, or `ValueError` if
+  /// some element of `Data` does not have one value per point, in
+  /// which case `Modes` is left unchanged.
+  const unsigned int N = NModes();
+  const unsigned int NPoints = Points.size();
+  const unsigned int NTimes = Data.size();
+  const unsigned int iMin = ellMinPlan*ellMinPlan;
+  for(unsigned int t=0; t<NTimes; ++t) {
+    if(Data[t].size()!=NPoints) {
+      return ValueError;
+    }
+  }
+  vector<vector<complex<double> > > Result(NTimes, vector<complex<double> >(iMin+N, 0.0));
+  vector<complex<double> > Buffer(SWSHPlanBlockSize*N);
+  vector<const complex<double>*> Rows(SWSHPlanBlockSize);
+  for(unsigned int p0=0; p0<NPoints; p0+=SWSHPlanBlockSize) {
+    const unsigned int NBlock = std::min(SWSHPlanBlockSize, NPoints-p0);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for(int b=0; b<int(NBlock); ++b) {
+      Rows[b] = Row(p0+b, &Buffer[b*N]);
+    }
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for(int t=0; t<int(NTimes); ++t) {
+      complex<double>* M = &Result[t][iMin];
+      for(unsigned int b=0; b<NBlock; ++b) {
+        const complex<double>* Y = Rows[b];
+        const complex<double> f = Weights[p0+b] * Data[t][p0+b];
+        for(unsigned int i=0; i<N; ++i) {
+          M[i] += std::conj(Y[i]) * f;
+        }
+      }
+    }
+  }
+  Modes.swap(Result);
+  return NoError;
+}
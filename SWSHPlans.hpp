@@ -0,0 +1,63 @@
+// Copyright (c) 2014, Michael Boyle
+// See LICENSE file for details
+
+#ifndef SWSHPLANS_HPP
+#define SWSHPLANS_HPP
+
+#include <string>
+#include "SWSHs.hpp"
+
+namespace SphericalFunctions {
+
+  /// Object for repeatedly evaluating and projecting modes on a fixed set of points
+  class SWSHPlan {
+    /// The points are given as rotors, just as for the `SWSH` object.
+    /// Constructing the plan computes the SWSHs for every point and
+    /// every mode in the ell range, and stores them according to the
+    /// requested `StorageType`:
+    ///
+    ///   * `Dense` stores the complex matrix of SWSH values.
+    ///   * `Factored` uses the fact that the phase of each SWSH
+    ///     depends on the point only through a factor \f$U^m V\f$,
+    ///     so it stores one real amplitude per point and mode, plus
+    ///     the two complex numbers \f$U\f$ and \f$V\f$ per point.
+    ///     This takes about half the memory of `Dense`.
+    ///   * `OnTheFly` stores only the points and recomputes the SWSHs
+    ///     whenever they are needed.
+    ///
+    /// Evaluation and projection of many mode vectors are done in
+    /// blocks of points, so that each block of SWSH values stays in
+    /// cache while every mode vector passes through it.  Like
+    /// `WignerDMatrix::Evaluate`, these return a status code from
+    /// `Errors.hpp` rather than throwing.  The plan is immutable once
+    /// constructed, so a single instance may be shared between
+    /// threads; the time steps are also distributed across threads
+    /// when compiled with OpenMP support.  Plans may be written to
+    /// file and read back, so that they need not be rebuilt.
+  public:
+    enum StorageType { Dense, Factored, OnTheFly };
+  private:
+    int spin, ellMinPlan, ellMaxPlan;
+    StorageType Storage;
+    std::vector<Quaternions::Quaternion> Points;
+    std::vector<double> Weights;
+    std::vector<std::complex<double> > SWSHValues;
+    std::vector<double> Amplitudes;
+    std::vector<std::complex<double> > Phases;
+    unsigned int NModes() const { return (ellMaxPlan+1)*(ellMaxPlan+1) - ellMinPlan*ellMinPlan; }
+    void Build();
+    const std::complex<double>* Row(const unsigned int p, std::complex<double>* Buffer) const;
+  public:
+    SWSHPlan(const int s, const std::vector<Quaternions::Quaternion>& iPoints, const int iEllMin, const int iEllMax,
+             const StorageType iStorage=Dense, const std::vector<double>& iWeights=std::vector<double>());
+    SWSHPlan(const std::string& FileName);
+    void Write(const std::string& FileName) const;
+    int Evaluate(const std::vector<std::vector<std::complex<double> > >& Modes,
+                 std::vector<std::vector<std::complex<double> > >& Data) const;
+    int Project(const std::vector<std::vector<std::complex<double> > >& Data,
+                std::vector<std::vector<std::complex<double> > >& Modes) const;
+  };
+
+} // namespace SphericalFunctions
+
+#endif // SWSHPLANS_HPP
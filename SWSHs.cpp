@@ -2,9 +2,14 @@
 // See LICENSE file for details
 
 #include "SWSHs.hpp"
+#include <iostream>
+#include <cmath>
+#include "Errors.hpp"
+
+#define INFOTOCERR std::cerr << __FILE__ << ":" << __LINE__ << ":" << __func__ << ": "
 
 int abs(const int a) {
-  return (a>0 ? -a : a);
+  return (a>0 ? a : -a);
 }
 
 /// Return the size of the array needed to express this ell
@@ -47,3 +52,269 @@ std::complex<double> SphericalFunctions::SWSH::Evaluate(const std::vector<std::c
   return r;
 }
 
+/// Evaluate Modes and their derivatives with respect to the generators of rotation at the point given by the rotor.
+std::vector<std::complex<double> > SphericalFunctions::SWSH::EvaluateGradient(const std::vector<std::complex<double> >& Modes, const bool LeftGenerators) const {
+  ///
+  /// \param Modes vector<complex<double> > in spinsfast order (which include ell=0, etc.)
+  /// \param LeftGenerators If true (the default), differentiate with respect to \f$\exp(\theta \hat{e}_j/2)\, R\f$; otherwise \f$R\, \exp(\theta \hat{e}_j/2)\f$
+  ///
+  /// The returned vector has four elements: the value returned by
+  /// `Evaluate`, followed by its derivatives with respect to
+  /// \f$\theta\f$ for rotations about the \f$x\f$, \f$y\f$, and
+  /// \f$z\f$ axes, evaluated at \f$\theta=0\f$.  See
+  /// `WignerDMatrix::Gradient` for details.
+  ///
+  /// For left generators, the ladder operators are moved onto the
+  /// modes, so each SWSH is evaluated only once.  Only complete ell
+  /// blocks of `Modes` are used, and modes with ell greater than
+  /// `ellMax` are ignored.
+
+  const std::complex<double> I(0.0, 1.0);
+  const LadderOperatorFactorSingleton& LadderOperatorFactor = LadderOperatorFactorSingleton::Instance();
+  std::vector<std::complex<double> > r(4, std::complex<double>(0.0));
+
+  for(int ell=abs(spin); ell<=ellMax && N_ellm(ell)<=int(Modes.size()); ++ell) {
+    const int i0 = ell*ell+ell;
+    for(int m=-ell; m<=ell; ++m) {
+      if(LeftGenerators) {
+        const std::complex<double> Y = (*this)(ell,m);
+        const std::complex<double> Up = (m>-ell ? LadderOperatorFactor(ell, m-1) * Modes[i0+m-1] : 0.0);
+        const std::complex<double> Down = (m<ell ? LadderOperatorFactor(ell, m) * Modes[i0+m+1] : 0.0);
+        r[0] += Modes[i0+m] * Y;
+        r[1] += (0.5 * I * (Up + Down)) * Y;
+        r[2] += (0.5 * (Up - Down)) * Y;
+        r[3] += (I * double(m) * Modes[i0+m]) * Y;
+      } else {
+        const std::vector<std::complex<double> > dD = D.Gradient(ell, m, -spin, false);
+        const std::complex<double> Factor = sign * std::sqrt((2*ell+1)/(4*M_PI)) * Modes[i0+m];
+        for(unsigned int j=0; j<4; ++j) {
+          r[j] += Factor * dD[j];
+        }
+      }
+    }
+  }
+
+  return r;
+}
+
+/// Compute the nodes and weights for Gauss-Legendre quadrature on [-1,1]
+static void GaussLegendre(const unsigned int N, std::vector<double>& Nodes, std::vector<double>& Weights) {
+  Nodes.resize(N);
+  Weights.resize(N);
+  for(unsigned int i=0; i<N; ++i) {
+    double x = std::cos(M_PI*(i+0.75)/(N+0.5));
+    double dP = 0.0;
+    for(unsigned int iteration=0; iteration<100; ++iteration) {
+      // Evaluate the Legendre polynomial and its derivative by recursion
+      double P0 = 1.0, P1 = x;
+      for(unsigned int n=2; n<=N; ++n) {
+        const double P2 = ((2*n-1)*x*P1 - (n-1)*P0)/n;
+        P0 = P1;
+        P1 = P2;
+      }
+      dP = N*(x*P1 - P0)/(x*x-1.0);
+      const double dx = P1/dP;
+      x -= dx;
+      if(std::fabs(dx)<1.e-15) { break; }
+    }
+    Nodes[i] = x;
+    Weights[i] = 2.0/((1.0-x*x)*dP*dP);
+  }
+}
+
+/// Construct the boost transformation for the given spin, velocity, and ell ranges.
+SphericalFunctions::SWSHBoost::SWSHBoost(const int s, const std::vector<double>& v, const int iEllMaxIn, const int iEllMaxOut, const double ConformalWeight)
+  : spin(s), ellMaxIn(iEllMaxIn), ellMaxOut(iEllMaxOut), NIn(N_ellm(iEllMaxIn)), NOut(N_ellm(iEllMaxOut)),
+    TransferMatrix(NIn*NOut, std::complex<double>(0.0))
+{
+  ///
+  /// \param s Spin weight of the function
+  /// \param v Three-velocity of the boost (in units of c)
+  /// \param iEllMaxIn Largest ell present in the input modes
+  /// \param iEllMaxOut Largest ell to compute in the output modes
+  /// \param ConformalWeight Conformal weight \f$w\f$ of the function (defaults to 0)
+  ///
+  /// The new frame moves with velocity \f$\vec{v}\f$ relative to the
+  /// original frame.  A direction \f$\hat{n}'\f$ in the new frame
+  /// corresponds to the direction \f$\hat{n}\f$ in the original
+  /// frame given by the aberration formula
+  /// \f[
+  ///   \hat{n} = \frac{(\hat{n}'\cdot\hat{v} + \beta)\, \hat{v} + (\hat{n}' - (\hat{n}'\cdot\hat{v})\, \hat{v})/\gamma} {1 + \beta\, \hat{n}'\cdot\hat{v}},
+  /// \f]
+  /// and the transformed function is
+  /// \f[
+  ///   f'(R') = K^w\, f(R), \qquad K = \frac{1} {\gamma\, (1 + \beta\, \hat{n}'\cdot\hat{v})},
+  /// \f]
+  /// where \f$R\f$ is the rotor taking \f$\hat{z}\f$ to \f$\hat{n}\f$
+  /// and \f$\hat{x}\f$ to the image of the tetrad vector at
+  /// \f$\hat{n}'\f$.  Using that rotor, rather than the angles of
+  /// \f$\hat{n}\f$, automatically supplies the spin phase.
+  ///
+  /// The output modes are obtained by Gauss-Legendre quadrature in
+  /// the new frame.  Aberration compresses the input function toward
+  /// \f$\hat{v}\f$ by up to the Doppler factor \f$D =
+  /// \sqrt{(1+\beta)/(1-\beta)}\f$, so the boosted function carries
+  /// significant power up to roughly \f$D\f$ `iEllMaxIn`, even though
+  /// the input is band-limited to `iEllMaxIn`.  The grid therefore
+  /// integrates exactly any function band-limited to \f$L = \lceil D\f$
+  /// `iEllMaxIn` \f$\rceil +\f$ `iEllMaxOut`; a grid sized by
+  /// `iEllMaxIn+iEllMaxOut` alone would alias that power into the
+  /// output modes.  The boosted function is still not strictly
+  /// band-limited, but the remaining error decays rapidly with
+  /// \f$L\f$.
+
+  if(v.size()!=3) {
+    INFOTOCERR << "Velocity has size " << v.size() << "; it must have size 3." << std::endl;
+    throw(ValueError);
+  }
+  const double beta = std::sqrt(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]);
+  if(beta>=1.0) {
+    INFOTOCERR << "|v| = " << beta << "; the speed must be less than 1." << std::endl;
+    throw(ValueError);
+  }
+  if(iEllMaxIn<0 || iEllMaxIn>ellMax || iEllMaxOut<0 || iEllMaxOut>ellMax) {
+    INFOTOCERR << "(ellMaxIn, ellMaxOut) = (" << iEllMaxIn << ", " << iEllMaxOut << "); both must be in [0," << ellMax << "]."
+               << "\nTo increase this bound, edit 'ellMax' in Combinatorics.hpp and recompile." << std::endl;
+    throw(IndexOutOfBounds);
+  }
+  const double gamma = 1.0/std::sqrt(1.0-beta*beta);
+  const double vhat[3] = { (beta>0 ? v[0]/beta : 0.0), (beta>0 ? v[1]/beta : 0.0), (beta>0 ? v[2]/beta : 1.0) };
+
+  // Quadrature grid in the new frame, large enough for the Doppler-compressed input
+  const int L = int(std::ceil(ellMaxIn*std::sqrt((1.0+beta)/(1.0-beta)))) + ellMaxOut;
+  const unsigned int NTheta = L+1;
+  const unsigned int NPhi = 2*L+1;
+  std::vector<double> CosTheta, Weights;
+  GaussLegendre(NTheta, CosTheta, Weights);
+
+  // The output SWSHs depend on phi' only through exp(i*m*phi'), so the
+  // sums over phi' in each ring of constant theta' are done first, for
+  // each output m.  Each point then costs O(NIn*(2*ellMaxOut+1)), and
+  // each ring O(NIn*NOut).  Rings are distributed across threads, each
+  // with its own accumulator.
+  const unsigned int NM = 2*ellMaxOut+1;
+  #ifdef _OPENMP
+  #pragma omp parallel
+  #endif
+  {
+    SWSH YIn(spin), YOut(spin);
+    YIn.RaiseErrorOnBadIndices(false);
+    YOut.RaiseErrorOnBadIndices(false);
+    std::vector<std::complex<double> > In(NIn), Ring(NM*NIn), Phases(NM);
+    std::vector<std::complex<double> > Accumulator(NOut*NIn, std::complex<double>(0.0));
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for(int j=0; j<int(NTheta); ++j) {
+      const double thetap = std::acos(CosTheta[j]);
+      std::fill(Ring.begin(), Ring.end(), std::complex<double>(0.0));
+      for(unsigned int k=0; k<NPhi; ++k) {
+        const double phip = 2*M_PI*k/NPhi;
+        const double np[3] = { std::sin(thetap)*std::cos(phip), std::sin(thetap)*std::sin(phip), std::cos(thetap) };
+        // The tetrad vector at n' is the image of x under the rotor for (theta', phi')
+        const double tp[3] = { std::cos(thetap)*std::cos(phip), std::cos(thetap)*std::sin(phip), -std::sin(thetap) };
+
+        // Aberrate the point and push the tetrad vector forward
+        const double npv = np[0]*vhat[0] + np[1]*vhat[1] + np[2]*vhat[2];
+        const double tpv = tp[0]*vhat[0] + tp[1]*vhat[1] + tp[2]*vhat[2];
+        const double a = 1.0 + beta*npv;
+        double n[3], t[3];
+        for(unsigned int i=0; i<3; ++i) {
+          n[i] = ((npv + beta)*vhat[i] + (np[i] - npv*vhat[i])/gamma) / a;
+        }
+        for(unsigned int i=0; i<3; ++i) {
+          t[i] = (tpv*vhat[i] + (tp[i] - tpv*vhat[i])/gamma - n[i]*beta*tpv) / a;
+        }
+
+        // Find the rotor taking z to n and x to the direction of t
+        const double theta = std::acos(std::max(-1.0, std::min(1.0, n[2])));
+        const double phi = std::atan2(n[1], n[0]);
+        const double thetahat[3] = { std::cos(theta)*std::cos(phi), std::cos(theta)*std::sin(phi), -std::sin(theta) };
+        const double psi = std::atan2( (thetahat[1]*t[2]-thetahat[2]*t[1])*n[0]
+                                       + (thetahat[2]*t[0]-thetahat[0]*t[2])*n[1]
+                                       + (thetahat[0]*t[1]-thetahat[1]*t[0])*n[2],
+                                       thetahat[0]*t[0] + thetahat[1]*t[1] + thetahat[2]*t[2] );
+        YIn.SetRotation(Quaternions::Quaternion(theta, phi) * Quaternions::Quaternion(std::cos(psi/2), 0, 0, std::sin(psi/2)));
+
+        const double ConformalFactor = std::pow(1.0/(gamma*a), ConformalWeight);
+        for(int ell=0, i=0; ell<=ellMaxIn; ++ell) {
+          for(int m=-ell; m<=ell; ++m, ++i) {
+            In[i] = (ell<std::abs(spin) ? 0.0 : ConformalFactor * YIn(ell, m));
+          }
+        }
+        // Phases[ellMaxOut+m] = exp(-i*m*phi')
+        const std::complex<double> Phase(std::cos(phip), -std::sin(phip));
+        Phases[ellMaxOut] = 1.0;
+        for(int m=1; m<=ellMaxOut; ++m) {
+          Phases[ellMaxOut+m] = Phases[ellMaxOut+m-1] * Phase;
+          Phases[ellMaxOut-m] = std::conj(Phases[ellMaxOut+m]);
+        }
+        for(unsigned int mi=0; mi<NM; ++mi) {
+          std::complex<double>* RingRow = &Ring[mi*NIn];
+          for(unsigned int i=0; i<NIn; ++i) {
+            RingRow[i] += Phases[mi] * In[i];
+          }
+        }
+      }
+
+      // Project the ring onto the output SWSHs, evaluated at phi'=0
+      YOut.SetAngles(thetap, 0.0);
+      for(int ell=std::abs(spin); ell<=ellMaxOut; ++ell) {
+        for(int m=-ell; m<=ell; ++m) {
+          const std::complex<double> Out = Weights[j] * (2*M_PI/NPhi) * std::conj(YOut(ell, m));
+          const std::complex<double>* RingRow = &Ring[(ellMaxOut+m)*NIn];
+          std::complex<double>* Row = &Accumulator[(ell*ell+ell+m)*NIn];
+          for(unsigned int i=0; i<NIn; ++i) {
+            Row[i] += Out * RingRow[i];
+          }
+        }
+      }
+    }
+    #ifdef _OPENMP
+    #pragma omp critical
+    #endif
+    for(unsigned int i=0; i<NOut*NIn; ++i) {
+      TransferMatrix[i] += Accumulator[i];
+    }
+  }
+}
+
+/// Transform the modes at a single instant.
+std::vector<std::complex<double> > SphericalFunctions::SWSHBoost::operator()(const std::vector<std::complex<double> >& Modes) const {
+  ///
+  /// \param Modes vector<complex<double> > in spinsfast order (which include ell=0, etc.)
+  ///
+  /// The output has the same ordering, going up to the `ellMaxOut`
+  /// given to the constructor.  Input modes beyond the `ellMaxIn`
+  /// given to the constructor are ignored; missing modes are treated
+  /// as zero.
+  std::vector<std::complex<double> > Boosted(NOut, std::complex<double>(0.0));
+  const unsigned int N = std::min(NIn, (unsigned int)(Modes.size()));
+  for(unsigned int o=0; o<NOut; ++o) {
+    const std::complex<double>* Row = &TransferMatrix[o*NIn];
+    std::complex<double> Sum(0.0);
+    for(unsigned int i=0; i<N; ++i) {
+      Sum += Row[i] * Modes[i];
+    }
+    Boosted[o] = Sum;
+  }
+  return Boosted;
+}
+
+/// Transform the modes at each of a series of instants.
+std::vector<std::vector<std::complex<double> > > SphericalFunctions::SWSHBoost::operator()(const std::vector<std::vector<std::complex<double> > >& Modes) const {
+  ///
+  /// \param Modes vector<vector<complex<double> > > indexed as [time][mode], each in spinsfast order
+  ///
+  /// This is equivalent to applying the single-instant version to
+  /// each element of `Modes`, except that the time steps are
+  /// distributed across threads when compiled with OpenMP support.
+  std::vector<std::vector<std::complex<double> > > Boosted(Modes.size());
+  #ifdef _OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif
+  for(int t=0; t<int(Modes.size()); ++t) {
+    Boosted[t] = (*this)(Modes[t]);
+  }
+  return Boosted;
+}
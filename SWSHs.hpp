@@ -34,6 +34,42 @@ namespace SphericalFunctions {
       return sign * std::sqrt((2*ell+1)/(4*M_PI)) * D(ell, m, -spin);
     }
     std::complex<double> Evaluate(const std::vector<std::complex<double> >& Modes) const;
+    std::vector<std::complex<double> > EvaluateGradient(const std::vector<std::complex<double> >& Modes, const bool LeftGenerators=true) const;
+  };
+
+  /// Object for transforming modes of spin-weighted functions under a Lorentz boost
+  class SWSHBoost {
+    /// This object is a functor.  Constructing it for a given spin,
+    /// velocity, and pair of ell ranges builds the complete linear
+    /// map from input modes to boosted output modes: every point of
+    /// an output quadrature grid is aberrated, the input SWSHs are
+    /// evaluated at the corresponding rotor (which incorporates the
+    /// spin rotation of the tetrad), the conformal factor is applied,
+    /// and the result is projected back onto the output SWSHs.  All
+    /// of that is folded into one dense matrix, so transforming the
+    /// data at each time step is just a matrix-vector product, and
+    /// the object can be reused for every time step with the same
+    /// velocity.  The object is immutable once constructed, so one
+    /// instance may be shared between threads.
+    ///
+    /// Construction is much more expensive than application: with
+    /// \f$L = \lceil D\f$ `ellMaxIn` \f$\rceil +\f$ `ellMaxOut`,
+    /// where \f$D = \sqrt{(1+\beta)/(1-\beta)}\f$ is the Doppler
+    /// factor, it evaluates all input SWSHs at \f$(L+1)(2L+1)\f$
+    /// aberrated points, and costs roughly \f$2 L^2\f$ `NIn`
+    /// \f$\times\f$ `(2*ellMaxOut+1)` complex multiply-adds (a few
+    /// seconds on one core for ell=32 in and out at small velocity,
+    /// growing like \f$D^2\f$ as \f$\beta \to 1\f$).  The rings of constant \f$\theta'\f$ are distributed
+    /// across threads when compiled with OpenMP support.  So build one
+    /// object per velocity and reuse it.
+  private:
+    int spin, ellMaxIn, ellMaxOut;
+    unsigned int NIn, NOut;
+    std::vector<std::complex<double> > TransferMatrix;
+  public:
+    SWSHBoost(const int s, const std::vector<double>& v, const int iEllMaxIn, const int iEllMaxOut, const double ConformalWeight=0.0);
+    std::vector<std::complex<double> > operator()(const std::vector<std::complex<double> >& Modes) const;
+    std::vector<std::vector<std::complex<double> > > operator()(const std::vector<std::vector<std::complex<double> > >& Modes) const;
   };
 
 } // namespace SphericalFunctions
@@ -35,58 +35,16 @@
 
 // The following will appear in the header of the `_wrap.cpp` file.
 %{
-  // The following allows us to elegantly fail in python from manual
-  // interrupts and floating-point exceptions found in the c++ code.
-  // The setjmp part of this was inspired by the post
-  // <http://stackoverflow.com/a/12155582/1194883>.  The code for
-  // setting the csr flags is taken from SpEC.
-  #include <csetjmp>
-  #include <csignal>
-  #ifdef __APPLE__
-    #include <xmmintrin.h>
-    int fegetexcept() { return _mm_getcsr(); }
-  #else
-    #include <fenv.h>     // For feenableexcept. Doesn't seem to be a <cfenv>
-    #ifndef __USE_GNU
-      extern "C" int feenableexcept (int EXCEPTS);
-    #endif
-  #endif
-  namespace SphericalFunctions {
-    static sigjmp_buf FloatingPointExceptionJumpBuffer;
-    void FloatingPointExceptionHandler(int sig) {
-      siglongjmp(FloatingPointExceptionJumpBuffer, sig);
-    }
-    class ExceptionHandlerSwitcher {
-    private:
-      int OriginalExceptionFlags;
-      void (*OriginalFloatingPointExceptionHandler)(int);
-    public:
-      ExceptionHandlerSwitcher()
-        : OriginalExceptionFlags(fegetexcept()),
-          OriginalFloatingPointExceptionHandler(signal(SIGFPE, FloatingPointExceptionHandler))
-      {
-        #ifdef __APPLE__
-          _mm_setcsr( _MM_MASK_MASK &~
-                     (_MM_MASK_OVERFLOW|_MM_MASK_INVALID|_MM_MASK_DIV_ZERO));
-        #else
-          feenableexcept(FE_INVALID | FE_DIVBYZERO | FE_OVERFLOW);
-        #endif
-      }
-      ~ExceptionHandlerSwitcher() {
-        #ifdef __APPLE__
-          _mm_setcsr(OriginalExceptionFlags);
-        #else
-          feenableexcept(OriginalExceptionFlags);
-        #endif
-        signal(SIGFPE, OriginalFloatingPointExceptionHandler);
-      }
-    };
-  }
-
+  // The numerical code is written to be safe under aggressive
+  // optimization (including -ffast-math), and does not rely on
+  // floating-point exceptions, so there is no need to trap SIGFPE
+  // around each call.  Errors are reported by throwing one of the
+  // codes in `Errors.hpp`, which are translated to python exceptions
+  // below.
   const char* const SphericalFunctionsErrors[] = {
     "This function is not yet implemented.",
     "Unknown exception",// "Failed system call.",
-    "Unknown exception",// "Bad file name.",
+    "Bad file name.",
     "Unknown exception",// "Failed GSL call.",
     "Unknown exception",
     "Unknown exception",
@@ -109,7 +67,7 @@
   PyObject* const SphericalFunctionsExceptions[] = {
     PyExc_NotImplementedError, // Not implemented
     PyExc_RuntimeError, // PyExc_SystemError, // Failed system call
-    PyExc_RuntimeError, // PyExc_IOError, // Bad file name
+    PyExc_IOError, // Bad file name
     PyExc_RuntimeError, // PyExc_RuntimeError, // GSL failed
     PyExc_RuntimeError, // [empty]
     PyExc_RuntimeError, // [empty]
@@ -135,22 +93,20 @@
 // It's a good idea to try to keep this part brief, just to cut down
 // the size of the wrapper file.
 %exception {
-  if (!sigsetjmp(SphericalFunctions::FloatingPointExceptionJumpBuffer, 1)) {
-    try {
-      // const SphericalFunctions::ExceptionHandlerSwitcher Switcher;
-      $action;
-    } catch(int i) {
-      std::stringstream s;
-      if(i>-1 && i<SphericalFunctionsNumberOfErrors) { s << "$fulldecl: " << SphericalFunctionsErrors[i]; }
-      else  { s << "$fulldecl: Unknown exception number {" << i << "}"; }
+  try {
+    $action;
+  } catch(int i) {
+    std::stringstream s;
+    if(i>-1 && i<SphericalFunctionsNumberOfErrors) {
+      s << "$fulldecl: " << SphericalFunctionsErrors[i];
       PyErr_SetString(SphericalFunctionsExceptions[i], s.str().c_str());
-      return 0;
-    } catch(...) {
-      PyErr_SetString(PyExc_RuntimeError, "$fulldecl: Unknown exception; default handler");
-      return 0;
+    } else {
+      s << "$fulldecl: Unknown exception number {" << i << "}";
+      PyErr_SetString(PyExc_RuntimeError, s.str().c_str());
     }
-  } else {
-    PyErr_SetString(PyExc_RuntimeError, "$fulldecl: Caught a floating-point exception in the c++ code.");
+    return 0;
+  } catch(...) {
+    PyErr_SetString(PyExc_RuntimeError, "$fulldecl: Unknown exception; default handler");
     return 0;
   }
 }
@@ -170,6 +126,7 @@
   #include "Combinatorics.hpp"
   #include "WignerDMatrices.hpp"
   #include "SWSHs.hpp"
+  #include "SWSHPlans.hpp"
 %}
 
 
@@ -214,6 +171,7 @@ namespace std {
 %include "Combinatorics.hpp"
 %include "WignerDMatrices.hpp"
 %include "SWSHs.hpp"
+%include "SWSHPlans.hpp"
 
 
 /// Add utility functions that are specific to python.  Note that
@@ -5,7 +5,6 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
-#include <cfloat>
 
 #include "Errors.hpp"
 
@@ -19,20 +18,15 @@ using std::endl;
 #define INFOTOCERR std::cerr << __FILE__ << ":" << __LINE__ << ":" << __func__ << ": "
 
 
-const WignerCoefficientSingleton* WignerCoefficientSingleton::WignerCoefficientInstance = NULL;
-
-
 /// Construct the D matrix object given the (optional) rotor.
 WignerDMatrix::WignerDMatrix(const Quaternion& R)
-  : ErrorOnBadIndices(true),
+  : ErrorOnBadIndices(true), UseSumCoefficientTable(false),
     BinomialCoefficient(BinomialCoefficientSingleton::Instance()),
     WignerCoefficient(WignerCoefficientSingleton::Instance()),
-    Ra(R[0], R[3]), Rb(R[2], R[1]),
-    absRa(abs(Ra)), absRb(abs(Rb)),
-    absRRatioSquared(absRa>epsilon ? absRb*absRb/(absRa*absRa) : 0.0),
-    intlog10absRa(absRa>epsilon ? std::log10(absRa) : DBL_MIN_10_EXP),
-    intlog10absRb(absRb>epsilon ? std::log10(absRb) : DBL_MIN_10_EXP)
-{ }
+    LadderOperatorFactor(LadderOperatorFactorSingleton::Instance())
+{
+  SetRotation(R);
+}
 
 /// Reset the rotor for this object to the given value.
 WignerDMatrix& WignerDMatrix::SetRotation(const Quaternion& R) {
@@ -40,60 +34,272 @@ WignerDMatrix& WignerDMatrix::SetRotation(const Quaternion& R) {
   Rb = std::complex<double>(R[2], R[1]);
   absRa = abs(Ra);
   absRb = abs(Rb);
-  absRRatioSquared = absRa>epsilon ? absRb*absRb/(absRa*absRa) : 0.0;
-  intlog10absRa = absRa>epsilon ? std::log10(absRa) : DBL_MIN_10_EXP;
-  intlog10absRb = absRb>epsilon ? std::log10(absRb) : DBL_MIN_10_EXP;
+  // These are only used away from the poles, where both are well defined
+  RaPhase = (absRa>=epsilon ? Ra/absRa : std::complex<double>(1.0));
+  RbPhase = (absRb>=epsilon ? Rb/absRb : std::complex<double>(1.0));
+  // The smaller of |Ra|^2/|Rb|^2 and |Rb|^2/|Ra|^2, so the sums never overflow
+  absRRatioSquared = (absRa>=absRb
+                      ? (absRa>=epsilon ? absRb*absRb/(absRa*absRa) : 0.0)
+                      : absRa*absRa/(absRb*absRb));
   return *this;
 }
 
+/// Handle a request for invalid indices, according to `ErrorOnBadIndices`.
+std::complex<double> WignerDMatrix::BadIndices(const int ell, const int mp, const int m) const {
+  if(ErrorOnBadIndices) {
+    INFOTOCERR << "(" << ell << ", " << mp << ", " << m << ") is not a valid set of indices (ellMax = " << ellMax << ").\n"
+               << "If you want this object (let's call it `D`) to return 0.0 when invalid\n"
+               << " indices are requested, you can set `D.ErrorOnBadIndices = false`.\n" << std::endl;
+    throw(ValueError);
+  }
+  return std::complex<double>(0.0, 0.0);
+}
+
 /// Evaluate the D matrix element for the given (ell, mp, m) indices.
 std::complex<double> WignerDMatrix::operator()(const int ell, const int mp, const int m) const {
-  // If either sub-rotor, when raised to the exponent (mp-m), and
-  // multiplied by anything within machine precision of 1, is not
-  // representable as a floating-point number, just treat it as zero.
-  if(std::abs(mp)>ell || std::abs(m)>ell) {
-    if(ErrorOnBadIndices) {
-      INFOTOCERR << "(" << ell << ", " << mp << ", " << m << ") is not a valid set of indices.\n"
-                 << "If you want this object (let's call it `D`) to return 0.0 when invalid\n"
-                 << " indices are requested, you can set `D.ErrorOnBadIndices = false`.\n" << std::endl;
-      throw(ValueError);
-    } else {
-      return std::complex<double>(0.0, 0.0);
-    }
+  if(ell>ellMax || std::abs(mp)>ell || std::abs(m)>ell) {
+    return BadIndices(ell, mp, m);
   }
-  if(absRa < epsilon || 2*intlog10absRa*(mp-m)<DBL_MIN_10_EXP+17) {
+  return Element(ell, mp, m);
+}
+
+/// Evaluate the D matrix element, assuming the indices are valid.
+std::complex<double> WignerDMatrix::Element(const int ell, const int mp, const int m) const {
+  // The element is a sum over rho of terms proportional to
+  //   |Ra|^(2*ell+mp-m-2*rho) * |Rb|^(m-mp+2*rho),
+  // times the phases of Ra^(m+mp) and Rb^(m-mp).  Both exponents are
+  // nonnegative over the whole range of rho, so pulling out the
+  // largest power of whichever of |Ra| or |Rb| is bigger leaves a
+  // polynomial in a ratio that is at most 1.  Thus, no intermediate
+  // quantity can overflow, and anything too small to represent
+  // underflows harmlessly to zero.  This is also why it is safe to
+  // compile with -ffast-math: no step relies on detecting NaNs or
+  // infinities.
+  if(absRa < epsilon) {
     return (mp!=-m ? 0.0 : ((ell+mp)%2==0 ? 1.0 : -1.0) * std::pow(Rb, 2*m) );
   }
-  if(absRb < epsilon || 2*intlog10absRb*(mp-m)<DBL_MIN_10_EXP+17) {
+  if(absRb < epsilon) {
     return (mp!=m ? 0.0 : std::pow(Ra, 2*m) );
   }
-  const int rhoMin = std::max(0,mp-m);
-  const int rhoMax = std::min(ell+mp,ell-m);
-  if(absRa < 1.e-3) { // Deal with NANs in certain cases
-    const std::complex<double> Prefactor =
-      WignerCoefficient(ell, mp, m) * std::pow(Ra, m+mp) * std::pow(Rb, m-mp);
-    const double absRaSquared = absRa*absRa;
-    const double absRbSquared = absRb*absRb;
-    double Sum = 0.0;
-    for(int rho=rhoMax; rho>=rhoMin; --rho) {
-      const double aTerm = std::pow(absRaSquared, ell-m-rho);
-      if(aTerm != aTerm || aTerm<1.e-100) { // This assumes --fast-math is off
-        Sum *= absRbSquared;
-        continue;
+  // If |Ra|>=|Rb|, the sum is a polynomial in |Rb|^2/|Ra|^2, taken
+  // from rhoMax down to rhoMin; otherwise it is a polynomial in
+  // |Ra|^2/|Rb|^2, taken from rhoMin up to rhoMax.
+  const bool RaIsLarger = (absRa>=absRb);
+  double Prefactor, Sum = 0.0;
+  int rhoMin, rhoMax;
+  if(UseSumCoefficientTable) {
+    // Fetched here, so the table is only built if it is actually used
+    const WignerSumCoefficientSingleton& WignerSumCoefficient = WignerSumCoefficientSingleton::Instance();
+    const WignerSumCoefficientSingleton::Index& Index = WignerSumCoefficient(ell, mp, m);
+    const double* Coefficient = WignerSumCoefficient.Coefficients(Index);
+    rhoMin = Index.rhoMin;
+    rhoMax = Index.rhoMax;
+    const int N = rhoMax-rhoMin;
+    Prefactor = Coefficient[0];
+    if(RaIsLarger) {
+      for(int i=1; i<=N+1; ++i) {
+        Sum = Coefficient[i] + ( Sum * absRRatioSquared );
+      }
+    } else {
+      for(int i=N+1; i>=1; --i) {
+        Sum = Coefficient[i] + ( Sum * absRRatioSquared );
       }
-      Sum = ( (rho%2==0 ? 1 : -1) * BinomialCoefficient(ell+mp,rho) * BinomialCoefficient(ell-mp, ell-rho-m) * aTerm )
-        + ( Sum * absRbSquared );
     }
-    return Prefactor * Sum * std::pow(absRbSquared, rhoMin);
   } else {
-    const std::complex<double> Prefactor =
-      (WignerCoefficient(ell, mp, m) * std::pow(absRa, 2*ell-2*m))
-      * std::pow(Ra, m+mp) * std::pow(Rb, m-mp);
-    double Sum = 0.0;
-    for(int rho=rhoMax; rho>=rhoMin; --rho) {
-      Sum = ( (rho%2==0 ? 1 : -1) * BinomialCoefficient(ell+mp,rho) * BinomialCoefficient(ell-mp, ell-rho-m) )
-        + ( Sum * absRRatioSquared );
+    rhoMin = std::max(0,mp-m);
+    rhoMax = std::min(ell+mp,ell-m);
+    Prefactor = WignerCoefficient(ell, mp, m);
+    if(RaIsLarger) {
+      for(int rho=rhoMax; rho>=rhoMin; --rho) {
+        Sum = ( (rho%2==0 ? 1 : -1) * BinomialCoefficient(ell+mp,rho) * BinomialCoefficient(ell-mp, ell-rho-m) )
+          + ( Sum * absRRatioSquared );
+      }
+    } else {
+      for(int rho=rhoMin; rho<=rhoMax; ++rho) {
+        Sum = ( (rho%2==0 ? 1 : -1) * BinomialCoefficient(ell+mp,rho) * BinomialCoefficient(ell-mp, ell-rho-m) )
+          + ( Sum * absRRatioSquared );
+      }
+    }
+  }
+  const int N = rhoMax-rhoMin;
+  const int k = std::abs(m-mp);
+  const double Magnitude = (RaIsLarger
+                            ? std::pow(absRa, 2*ell-k) * std::pow(absRb, k)
+                            : std::pow(absRa, 2*ell-k-2*N) * std::pow(absRb, k+2*N));
+  return (Prefactor * Magnitude * Sum) * std::pow(RaPhase, m+mp) * std::pow(RbPhase, m-mp);
+}
+
+/// Evaluate all D matrix elements in a range of ell values, returning a status code.
+int WignerDMatrix::Evaluate(const int iEllMin, const int iEllMax, std::vector<std::complex<double> >& Values) const {
+  ///
+  /// \param iEllMin Smallest ell value
+  /// \param iEllMax Largest ell value
+  /// \param Values Output vector, which will be resized as necessary
+  ///
+  /// The elements are stored in order of increasing ell, then mp,
+  /// then m, each of the latter running from -ell to ell.  The range
+  /// is checked once, before anything is evaluated; this function
+  /// never throws and never writes to `std::cerr`.  It returns
+  /// `NoError` on success, or the relevant code from `Errors.hpp`, in
+  /// which case `Values` is left unchanged.
+  if(iEllMin<0 || iEllMin>iEllMax) {
+    return ValueError;
+  }
+  if(iEllMax>ellMax) {
+    return IndexOutOfBounds;
+  }
+  const unsigned int i0 = (iEllMin*(4*iEllMin*iEllMin-1))/3;
+  const unsigned int i1 = ((iEllMax+1)*(4*(iEllMax+1)*(iEllMax+1)-1))/3;
+  Values.resize(i1-i0);
+  for(int ell=iEllMin, i=0; ell<=iEllMax; ++ell) {
+    for(int mp=-ell; mp<=ell; ++mp) {
+      for(int m=-ell; m<=ell; ++m, ++i) {
+        Values[i] = Element(ell, mp, m);
+      }
+    }
+  }
+  return NoError;
+}
+
+/// Evaluate the D matrix elements for a list of (ell, mp, m) indices, returning a status code.
+int WignerDMatrix::Evaluate(const std::vector<std::vector<int> >& Indices, std::vector<std::complex<double> >& Values) const {
+  ///
+  /// \param Indices vector<vector<int> > each element of which is (ell, mp, m)
+  /// \param Values Output vector, which will be resized as necessary
+  ///
+  /// All indices are checked before anything is evaluated; this
+  /// function never throws and never writes to `std::cerr`,
+  /// regardless of `ErrorOnBadIndices`.  It returns `NoError` on
+  /// success, or the relevant code from `Errors.hpp`, in which case
+  /// `Values` is left unchanged.
+  for(unsigned int i=0; i<Indices.size(); ++i) {
+    if(Indices[i].size()!=3) {
+      return ValueError;
+    }
+    const int ell=Indices[i][0], mp=Indices[i][1], m=Indices[i][2];
+    if(ell>ellMax || std::abs(mp)>ell || std::abs(m)>ell) {
+      return IndexOutOfBounds;
+    }
+  }
+  Values.resize(Indices.size());
+  for(unsigned int i=0; i<Indices.size(); ++i) {
+    Values[i] = Element(Indices[i][0], Indices[i][1], Indices[i][2]);
+  }
+  return NoError;
+}
+
+/// Evaluate the D matrix element and its derivatives with respect to the generators of rotation.
+std::vector<std::complex<double> > WignerDMatrix::Gradient(const int ell, const int mp, const int m, const bool LeftGenerators) const {
+  ///
+  /// \param ell
+  /// \param mp
+  /// \param m
+  /// \param LeftGenerators If true (the default), differentiate with respect to \f$\exp(\theta \hat{e}_j/2)\, R\f$; otherwise \f$R\, \exp(\theta \hat{e}_j/2)\f$
+  ///
+  /// The returned vector has four elements: the D matrix element
+  /// itself, followed by its derivatives with respect to \f$\theta\f$
+  /// for rotations about the \f$x\f$, \f$y\f$, and \f$z\f$ axes,
+  /// evaluated at \f$\theta=0\f$.
+  ///
+  /// The derivatives are given analytically by the ladder operators
+  /// acting on the first index (for left generators) or the second
+  /// index (for right generators), so only the two neighboring
+  /// elements of the D matrix need to be evaluated in addition to the
+  /// element itself.  This is much cheaper and more accurate than
+  /// finite differencing with respect to the rotor.
+
+  const std::complex<double> I(0.0, 1.0);
+  std::vector<std::complex<double> > Result(4);
+  Result[0] = (*this)(ell, mp, m);
+  if(ell>ellMax || std::abs(mp)>ell || std::abs(m)>ell) { // Only reached if ErrorOnBadIndices is false
+    return Result;
+  }
+  const int k = (LeftGenerators ? mp : m);
+  const double FactorUp = LadderOperatorFactor(ell, k);
+  const double FactorDown = (k>-ell ? LadderOperatorFactor(ell, k-1) : 0.0);
+  std::complex<double> Up(0.0), Down(0.0);
+  if(LeftGenerators) {
+    if(mp<ell) { Up = FactorUp * (*this)(ell, mp+1, m); }
+    if(mp>-ell) { Down = FactorDown * (*this)(ell, mp-1, m); }
+    Result[2] = 0.5 * (Up - Down);
+  } else {
+    if(m<ell) { Up = FactorUp * (*this)(ell, mp, m+1); }
+    if(m>-ell) { Down = FactorDown * (*this)(ell, mp, m-1); }
+    Result[2] = 0.5 * (Down - Up);
+  }
+  Result[1] = 0.5 * I * (Up + Down);
+  Result[3] = I * double(k) * Result[0];
+  return Result;
+}
+
+/// Evaluate the overlap of rotated modes with other modes, and its derivatives with respect to the generators of rotation.
+std::vector<std::complex<double> > WignerDMatrix::OverlapGradient(const std::vector<std::complex<double> >& A,
+                                                                   const std::vector<std::complex<double> >& B,
+                                                                   const bool LeftGenerators) const {
+  ///
+  /// \param A vector<complex<double> > in spinsfast order (which include ell=0, etc.)
+  /// \param B vector<complex<double> > in spinsfast order (which include ell=0, etc.)
+  /// \param LeftGenerators If true (the default), differentiate with respect to \f$\exp(\theta \hat{e}_j/2)\, R\f$; otherwise \f$R\, \exp(\theta \hat{e}_j/2)\f$
+  ///
+  /// The overlap is
+  /// \f[
+  ///   O(R) = \sum_{\ell} \sum_{m',m} \bar{A}_{\ell,m'}\, \mathfrak{D}^{(\ell)}_{m',m}(R)\, B_{\ell,m},
+  /// \f]
+  /// which is the inner product of `A` with the modes `B` rotated by
+  /// the current rotor.  The returned vector has four elements: the
+  /// overlap itself, followed by its derivatives with respect to
+  /// \f$\theta\f$ for rotations about the \f$x\f$, \f$y\f$, and
+  /// \f$z\f$ axes, evaluated at \f$\theta=0\f$.  Only complete ell
+  /// blocks present in both inputs are used.
+  ///
+  /// Because the ladder operators are moved onto the mode vectors,
+  /// each D matrix element is evaluated exactly once, which is the
+  /// same cost as evaluating the overlap alone.
+
+  const std::complex<double> I(0.0, 1.0);
+  std::vector<std::complex<double> > Result(4, std::complex<double>(0.0));
+  const unsigned int N = std::min(A.size(), B.size());
+  std::vector<std::complex<double> > Contracted(2*ellMax+1);
+  for(int ell=0; ell<=ellMax && (unsigned int)((ell+1)*(ell+1))<=N; ++ell) {
+    const int i0 = ell*ell+ell;
+    if(LeftGenerators) {
+      // Contracted[mp] = sum_m D(ell,mp,m) B(ell,m); the generators act on mp
+      for(int mp=-ell; mp<=ell; ++mp) {
+        std::complex<double> Sum(0.0);
+        for(int m=-ell; m<=ell; ++m) {
+          Sum += Element(ell, mp, m) * B[i0+m];
+        }
+        Contracted[ell+mp] = Sum;
+      }
+      for(int mp=-ell; mp<=ell; ++mp) {
+        const std::complex<double> Abar = std::conj(A[i0+mp]);
+        const std::complex<double> Up = (mp<ell ? LadderOperatorFactor(ell, mp) * Contracted[ell+mp+1] : 0.0);
+        const std::complex<double> Down = (mp>-ell ? LadderOperatorFactor(ell, mp-1) * Contracted[ell+mp-1] : 0.0);
+        Result[0] += Abar * Contracted[ell+mp];
+        Result[1] += Abar * (0.5 * I * (Up + Down));
+        Result[2] += Abar * (0.5 * (Up - Down));
+        Result[3] += Abar * (I * double(mp) * Contracted[ell+mp]);
+      }
+    } else {
+      // Contracted[m] = sum_mp conj(A(ell,mp)) D(ell,mp,m); the generators act on m
+      for(int m=-ell; m<=ell; ++m) {
+        Contracted[ell+m] = 0.0;
+      }
+      for(int mp=-ell; mp<=ell; ++mp) {
+        const std::complex<double> Abar = std::conj(A[i0+mp]);
+        for(int m=-ell; m<=ell; ++m) {
+          Contracted[ell+m] += Abar * Element(ell, mp, m);
+        }
+      }
+      for(int m=-ell; m<=ell; ++m) {
+        const std::complex<double> Up = (m>-ell ? LadderOperatorFactor(ell, m-1) * B[i0+m-1] : 0.0);
+        const std::complex<double> Down = (m<ell ? LadderOperatorFactor(ell, m) * B[i0+m+1] : 0.0);
+        Result[0] += Contracted[ell+m] * B[i0+m];
+        Result[1] += Contracted[ell+m] * (0.5 * I * (Up + Down));
+        Result[2] += Contracted[ell+m] * (0.5 * (Down - Up));
+        Result[3] += Contracted[ell+m] * (I * double(m) * B[i0+m]);
+      }
     }
-    return Prefactor * Sum * std::pow(absRRatioSquared, rhoMin);
   }
+  return Result;
 }
@@ -5,6 +5,7 @@
 #define WIGNERDMATRICES_HPP
 
 #include "Quaternions.hpp"
+#include <algorithm>
 #include "Combinatorics.hpp"
 
 namespace SphericalFunctions {
@@ -12,7 +13,6 @@ namespace SphericalFunctions {
   /// Object for pre-computing and retrieving coefficients for the Wigner D matrices
   class WignerCoefficientSingleton {
   private:
-    static const WignerCoefficientSingleton* WignerCoefficientInstance;
     std::vector<double> CoefficientTable;
     WignerCoefficientSingleton()
       : CoefficientTable(ellMax*(ellMax*(4*ellMax + 12) + 11)/3 + 1)
@@ -29,19 +29,13 @@ namespace SphericalFunctions {
         }
       }
     }
-    WignerCoefficientSingleton(const WignerCoefficientSingleton& that) {
-      WignerCoefficientInstance = that.WignerCoefficientInstance;
-    }
-    WignerCoefficientSingleton& operator=(const WignerCoefficientSingleton& that) {
-      if(this!=&that) WignerCoefficientInstance = that.WignerCoefficientInstance;
-      return *this;
-    }
+    WignerCoefficientSingleton(const WignerCoefficientSingleton&);
+    WignerCoefficientSingleton& operator=(const WignerCoefficientSingleton&);
     ~WignerCoefficientSingleton() { }
   public:
     static const WignerCoefficientSingleton& Instance() {
       static const WignerCoefficientSingleton Instance;
-      WignerCoefficientInstance = &Instance;
-      return *WignerCoefficientInstance;
+      return Instance;
     }
     inline double operator()(const int ell, const int mp, const int m) const {
       #ifdef DEBUG
@@ -56,6 +50,74 @@ namespace SphericalFunctions {
     }
   };
 
+  /// Object for pre-computing and retrieving the coefficients of the sum in the Wigner D matrices
+  class WignerSumCoefficientSingleton {
+    /// For each (ell, mp, m), this stores the `WignerCoefficient`
+    /// prefactor, followed by the signed products of binomial
+    /// coefficients appearing in the sum over rho, from rhoMax down to
+    /// rhoMin.  The Horner loop of `WignerDMatrix::operator()` reads
+    /// them in that order when \f$|R_a| \geq |R_b|\f$, and in the
+    /// reverse order otherwise.  The blocks for successive m values are
+    /// contiguous, so evaluating many elements in order streams
+    /// through memory sequentially, rather than jumping between
+    /// distant rows of the triangular binomial table.
+  public:
+    struct Index {
+      unsigned int Offset;
+      int rhoMin;
+      int rhoMax;
+    };
+  private:
+    std::vector<Index> IndexTable;
+    std::vector<double> CoefficientTable;
+    WignerSumCoefficientSingleton()
+      : IndexTable(ellMax*(ellMax*(4*ellMax + 12) + 11)/3 + 1)
+    {
+      const BinomialCoefficientSingleton& BinomialCoefficient = BinomialCoefficientSingleton::Instance();
+      const FactorialSingleton& Factorial = FactorialSingleton::Instance();
+      unsigned int i=0;
+      for(int ell=0; ell<=ellMax; ++ell) {
+        for(int mp=-ell; mp<=ell; ++mp) {
+          for(int m=-ell; m<=ell; ++m, ++i) {
+            IndexTable[i].Offset = CoefficientTable.size();
+            IndexTable[i].rhoMin = std::max(0,mp-m);
+            IndexTable[i].rhoMax = std::min(ell+mp,ell-m);
+            CoefficientTable.push_back(std::sqrt( Factorial(ell+m)*Factorial(ell-m)
+                                                  / double(Factorial(ell+mp)*Factorial(ell-mp)) ));
+            for(int rho=IndexTable[i].rhoMax; rho>=IndexTable[i].rhoMin; --rho) {
+              CoefficientTable.push_back( (rho%2==0 ? 1 : -1)
+                                          * BinomialCoefficient(ell+mp,rho) * BinomialCoefficient(ell-mp, ell-rho-m) );
+            }
+          }
+        }
+      }
+    }
+    WignerSumCoefficientSingleton(const WignerSumCoefficientSingleton&);
+    WignerSumCoefficientSingleton& operator=(const WignerSumCoefficientSingleton&);
+    ~WignerSumCoefficientSingleton() { }
+  public:
+    static const WignerSumCoefficientSingleton& Instance() {
+      static const WignerSumCoefficientSingleton Instance;
+      return Instance;
+    }
+    /// Return the rho bounds and the position of the coefficients for the given indices
+    inline const Index& operator()(const int ell, const int mp, const int m) const {
+      #ifdef DEBUG
+      if(ell>ellMax || std::abs(mp)>ell || std::abs(m)>ell) {
+        std::cerr << "\n\n(ell, mp, m) = (" << ell << ", " << mp << ", " << m << ")\tellMax = " << ellMax
+                  << "\nWignerSumCoefficientSingleton is only implemented up to ell=" << ellMax
+                  << ".\nTo increase this bound, edit 'ellMax' in " << __FILE__ << " and recompile." << std::endl;
+        throw(IndexOutOfBounds);
+      }
+      #endif
+      return IndexTable[ell*(ell*(4*ell + 6) + 5)/3 + mp*(2*ell + 1) + m];
+    }
+    /// Return a pointer to the prefactor, which is immediately followed by the sum coefficients
+    inline const double* Coefficients(const Index& I) const {
+      return &CoefficientTable[I.Offset];
+    }
+  };
+
   /// Object for computing the Wigner D matrices as functions of quaternion rotors
   class WignerDMatrix {
     /// Note that this object is a functor.  The rotation should be
@@ -63,19 +125,42 @@ namespace SphericalFunctions {
     /// with arguments (ell,mp,m).  The rotation can then be set to
     /// another value, and the process repeated.  Evaluation in this
     /// order is more efficient than the other way around.
+    ///
+    /// By default, the coefficients of the sum are computed from the
+    /// binomial table on each call.  Setting `UseSumCoefficientTable =
+    /// true` reads them instead from the precombined, contiguous
+    /// `WignerSumCoefficientSingleton` table, which is only built
+    /// (several MB for ell=32) the first time it is used.  The results
+    /// are identical, and the timings are comparable, so the table is
+    /// not worth its memory by default; see
+    /// `Notes/BenchmarkWignerDMatrices.cpp` to compare them.
+    ///
+    /// The `Evaluate` functions compute many elements at once.  They
+    /// check all of the requested indices first, and then report
+    /// problems by returning a code from `Errors.hpp` rather than by
+    /// throwing, so they are suitable for use in tight loops.
   public:
     bool ErrorOnBadIndices;
+    bool UseSumCoefficientTable;
   private:
     const BinomialCoefficientSingleton& BinomialCoefficient;
     const WignerCoefficientSingleton& WignerCoefficient;
-    std::complex<double> Ra, Rb;
+    const LadderOperatorFactorSingleton& LadderOperatorFactor;
+    std::complex<double> Ra, Rb, RaPhase, RbPhase;
     double absRa, absRb, absRRatioSquared;
-    int intlog10absRa, intlog10absRb;
+    std::complex<double> BadIndices(const int ell, const int mp, const int m) const;
+    std::complex<double> Element(const int ell, const int mp, const int m) const;
   public:
     WignerDMatrix(const Quaternions::Quaternion& iR=Quaternions::Quaternion(1,0,0,0));
     WignerDMatrix& SetRotation(const Quaternions::Quaternion& iR);
     WignerDMatrix& SetRotation(const double alpha, const double beta, const double gamma) { SetRotation(Quaternions::Quaternion(alpha, beta, gamma)); return *this; }
     std::complex<double> operator()(const int ell, const int mp, const int m) const;
+    int Evaluate(const int iEllMin, const int iEllMax, std::vector<std::complex<double> >& Values) const;
+    int Evaluate(const std::vector<std::vector<int> >& Indices, std::vector<std::complex<double> >& Values) const;
+    std::vector<std::complex<double> > Gradient(const int ell, const int mp, const int m, const bool LeftGenerators=true) const;
+    std::vector<std::complex<double> > OverlapGradient(const std::vector<std::complex<double> >& A,
+                                                       const std::vector<std::complex<double> >& B,
+                                                       const bool LeftGenerators=true) const;
   };
 
 } // namespace SphericalFunctions
@@ -28,6 +28,14 @@ elif isdir('../Quaternions') and isfile('../Quaternions/numpy.i'):
 else:
     raise EnvironmentError("Can't find `Quaternions` module.  Did you forget to `git submodule init` and `git submodule update`?")
 
+## Check for `--openmp` option; this must be removed before building
+## Quaternions, which does not know about it
+if '--openmp' in argv:
+    OpenMPArgs = ['-fopenmp']
+    argv.remove('--openmp')
+else:
+    OpenMPArgs = []
+
 ## Build Quaternions first
 print("\nInstalling Quaternions")
 cmd = ' '.join(['cd {0} && {1}'.format(QuaternionsPath, executable),]+argv)
@@ -90,6 +98,7 @@ if GSL :
                    'Combinatorics.cpp',
                    'WignerDMatrices.cpp',
                    'SWSHs.cpp',
+                   'SWSHPlans.cpp',
                    'SphericalFunctions.i']
     Dependencies = [QuaternionsPath+'/Quaternions.hpp',
                     QuaternionsPath+'/QuaternionUtilities.hpp',
@@ -97,6 +106,7 @@ if GSL :
                     'Combinatorics.hpp',
                     'WignerDMatrices.hpp',
                     'SWSHs.hpp',
+                    'SWSHPlans.hpp',
                     'Errors.hpp']
     Libraries = ['gsl', 'gslcblas']
     ## See if GSL_HOME is set; if so, use it
@@ -109,12 +119,14 @@ else :
                    'Combinatorics.cpp',
                    'WignerDMatrices.cpp',
                    'SWSHs.cpp',
+                   'SWSHPlans.cpp',
                    'SphericalFunctions.i']
     Dependencies = [QuaternionsPath+'/Quaternions.hpp',
                     QuaternionsPath+'/Utilities.hpp',
                     'Combinatorics.hpp',
                     'WignerDMatrices.hpp',
                     'SWSHs.hpp',
+                    'SWSHPlans.hpp',
                     'Errors.hpp']
     Libraries = []
 
@@ -171,8 +183,8 @@ setup(name="SphericalFunctions",
                   #define_macros = [('CodeRevision', CodeRevision)],
                   language='c++',
                   swig_opts=swig_opts,
-                  extra_link_args=['-fPIC'],
-                  extra_compile_args=['-Wno-deprecated', '-ffast-math', '-O3', GSLDef],
+                  extra_link_args=['-fPIC']+OpenMPArgs,
+                  extra_compile_args=['-Wno-deprecated', '-ffast-math', '-O3', GSLDef]+OpenMPArgs,
                   # extra_compile_args=['-fopenmp']
               ),
       ],